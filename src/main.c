@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #define MAX_TEXT_LENGTH 256
 #define MAX_LINES 100 // Increased to allow more lines
@@ -12,6 +13,12 @@
 #define INITIAL_SCREEN_WIDTH 800 // Initial window width
 #define TEXT_MARGIN 10 // Left margin
 #define MAX_HISTORY 50 // Max commands in history
+#define LINE_HEIGHT 20 // Vertical spacing between lines
+#define SELECTION_SCROLL_MS 50 // Auto-scroll step while dragging a selection past the edge
+#define MAX_SUGGESTIONS 8 // Completions listed when Tab is ambiguous
+#define LATENCY_BUCKET_US 100 // Latency histogram bucket width
+#define LATENCY_BUCKETS 1000 // 0-100ms, plus one overflow bucket
+#define MAX_PENDING_KEYS 64 // Key events waiting for their present
 
 /* We will use this renderer to draw into this window every frame. */
 static SDL_Window *window = NULL;
@@ -31,19 +38,23 @@ void cmd_clear(const char *input);
 void cmd_exit(const char *input);
 void cmd_help(const char *input);
 void cmd_echo(const char *input);
+void cmd_alias(const char *input);
+void cmd_latency(const char *input);
 void rewrap_text(void);
 void shift_lines_up(void);
 
-// Command table
-static const Command commands[] = {
+// Built-in commands, registered at startup
+static const Command builtin_commands[] = {
     {"clear", cmd_clear, "Clear all text in the terminal"},
     {"exit", cmd_exit, "Exit the application"},
     {"help", cmd_help, "List available commands"},
     {"-help", cmd_help, NULL}, // Alias, no description to avoid duplication
     {"-h", cmd_help, NULL},    // Alias
     {"echo", cmd_echo, "Print the following text"},
+    {"alias", cmd_alias, "Add a name for a command: alias <name> <command>"},
+    {"latency", cmd_latency, "Show keypress-to-present latency"},
 };
-static const int num_commands = sizeof(commands) / sizeof(commands[0]);
+static const int num_builtin_commands = sizeof(builtin_commands) / sizeof(builtin_commands[0]);
 
 // Global state for commands
 static char text_buffers[MAX_LINES][MAX_TEXT_LENGTH] = {{0}};
@@ -54,10 +65,470 @@ static int scroll_offset = 0;
 static int cursor_pos = 0;
 static bool *running = NULL; // Set in main
 static SDL_Color white = {255, 255, 255, 255};
+static SDL_Color black = {0, 0, 0, 255};
 static char *command_history[MAX_HISTORY] = {NULL};
 static int history_count = 0;
 static int history_pos = -1;
 
+// Input-priority mode (--input-priority): keyboard events are handled first and an
+// edited line is redrawn into frame_cache and presented straight away
+static bool input_priority = false;
+static SDL_Texture *frame_cache = NULL; // Last full frame of text lines
+static int frame_cache_w = 0, frame_cache_h = 0;
+
+// Keypress-to-present latency tracing (--latency-stats)
+static bool latency_stats = false;
+static Uint64 pending_keys[MAX_PENDING_KEYS]; // Event timestamps not yet presented
+static int pending_key_count = 0;
+static Uint64 latency_histogram[LATENCY_BUCKETS + 1] = {0};
+static Uint64 latency_samples = 0;
+
+// Selection state
+typedef enum {
+    SELECT_CHAR,
+    SELECT_WORD,
+    SELECT_LINE,
+} SelectMode;
+
+typedef struct {
+    int line;
+    int col; // Byte offset into text_buffers[line]
+} TextPos;
+
+static SDL_Color selection_color = {60, 90, 150, 255};
+static bool selecting = false; // Left button held after a click in the text area
+static bool has_selection = false;
+static SelectMode select_mode = SELECT_CHAR;
+static TextPos anchor_start, anchor_end; // Word/line under the initial click
+static TextPos sel_start, sel_end; // Normalized, sel_end is exclusive
+static float drag_x = 0.0f, drag_y = 0.0f; // Last mouse position while selecting
+static Uint32 last_autoscroll = 0;
+
+// Copied text, owned by SDL until the clipboard contents are replaced
+typedef struct {
+    char *text;
+    size_t len;
+} ClipboardText;
+
+static const char *clipboard_mime_types[] = {
+    "text/plain;charset=utf-8",
+    "text/plain",
+    "UTF8_STRING",
+    "TEXT",
+    "STRING",
+};
+
+static int compare_pos(TextPos a, TextPos b) {
+    return a.line != b.line ? a.line - b.line : a.col - b.col;
+}
+
+static bool is_word_char(char c) {
+    // Treat UTF-8 continuation/lead bytes as part of a word
+    return isalnum((unsigned char)c) || c == '_' || c == '-' || c == '.' || c == '/' || (unsigned char)c >= 0x80;
+}
+
+void clear_selection(void) {
+    selecting = false;
+    has_selection = false;
+}
+
+// Drop the selection before a line it covers is rewritten, so the highlight
+// and Ctrl+C never refer to text (or columns) that are gone
+void selection_line_edited(int line) {
+    if ((has_selection || selecting) && line >= sel_start.line && line <= sel_end.line) {
+        clear_selection();
+    }
+}
+
+// Map a point in render coordinates to a line and column in text_buffers
+static TextPos hit_test(float x, float y) {
+    TextPos pos = {0, 0};
+    int row = (int)SDL_floorf((y - TEXT_MARGIN) / LINE_HEIGHT);
+    // Past the drawn rows resolves to the line just above or below the view
+    if (row < -1) row = -1;
+    if (row > LINES_PER_SCREEN) row = LINES_PER_SCREEN;
+    pos.line = scroll_offset + row;
+    if (pos.line < 0) {
+        pos.line = 0;
+        return pos; // Above the first line: start of text
+    }
+    if (pos.line > current_line) {
+        pos.line = current_line;
+        pos.col = strlen(text_buffers[current_line]); // Below the last line: end of text
+        return pos;
+    }
+    const char *text = text_buffers[pos.line];
+    if (x > TEXT_MARGIN) {
+        size_t fit = 0;
+        TTF_MeasureString(font, text, strlen(text), (int)(x - TEXT_MARGIN), NULL, &fit);
+        pos.col = (int)fit;
+    }
+    return pos;
+}
+
+// Grow a position to the unit selected by the current click count
+static void expand_unit(TextPos pos, TextPos *start, TextPos *end) {
+    const char *text = text_buffers[pos.line];
+    int len = strlen(text);
+    *start = pos;
+    *end = pos;
+    if (select_mode == SELECT_LINE) {
+        start->col = 0;
+        end->col = len;
+    } else if (select_mode == SELECT_WORD && pos.col < len) {
+        if (is_word_char(text[pos.col])) {
+            while (start->col > 0 && is_word_char(text[start->col - 1])) start->col--;
+            while (end->col < len && is_word_char(text[end->col])) end->col++;
+        } else {
+            end->col = pos.col + 1; // Punctuation/space: select the single character
+        }
+    }
+}
+
+// Extend the selection from the anchor to the unit under pos
+static void update_selection(TextPos pos) {
+    TextPos start, end;
+    expand_unit(pos, &start, &end);
+    if (compare_pos(start, anchor_start) < 0) {
+        sel_start = start;
+        sel_end = anchor_end;
+    } else {
+        sel_start = anchor_start;
+        sel_end = compare_pos(end, anchor_end) > 0 ? end : anchor_end;
+    }
+    has_selection = compare_pos(sel_start, sel_end) != 0;
+}
+
+// Scroll one line while the mouse is dragged above or below the visible lines
+static void autoscroll_selection(Uint32 current_time) {
+    if (current_time - last_autoscroll < SELECTION_SCROLL_MS) return;
+    int output_height = 0;
+    SDL_GetCurrentRenderOutputSize(renderer, NULL, &output_height);
+    float bottom = TEXT_MARGIN + LINES_PER_SCREEN * LINE_HEIGHT;
+    if (bottom > output_height) bottom = output_height;
+    int max_offset = current_line - LINES_PER_SCREEN + 1;
+    if (max_offset < 0) max_offset = 0;
+    if (drag_y < TEXT_MARGIN && scroll_offset > 0) {
+        scroll_offset--;
+    } else if (drag_y >= bottom && scroll_offset < max_offset) {
+        scroll_offset++;
+    } else {
+        return;
+    }
+    last_autoscroll = current_time;
+    update_selection(hit_test(drag_x, drag_y));
+}
+
+static const void *SDLCALL clipboard_data(void *userdata, const char *mime_type, size_t *size) {
+    ClipboardText *clip = userdata;
+    *size = clip->len;
+    return clip->text;
+}
+
+static void SDLCALL clipboard_cleanup(void *userdata) {
+    ClipboardText *clip = userdata;
+    free(clip->text);
+    free(clip);
+}
+
+// Copy the selected range, joined with '\n', to the clipboard
+void copy_selection(void) {
+    if (!has_selection) return;
+    size_t total = 0;
+    for (int i = sel_start.line; i <= sel_end.line; i++) {
+        int start = i == sel_start.line ? sel_start.col : 0;
+        int end = i == sel_end.line ? sel_end.col : (int)strlen(text_buffers[i]);
+        total += end - start + 1;
+    }
+    ClipboardText *clip = calloc(1, sizeof(ClipboardText));
+    if (!clip) return;
+    clip->text = malloc(total + 1);
+    if (!clip->text) {
+        free(clip);
+        return;
+    }
+    char *out = clip->text;
+    for (int i = sel_start.line; i <= sel_end.line; i++) {
+        int start = i == sel_start.line ? sel_start.col : 0;
+        int end = i == sel_end.line ? sel_end.col : (int)strlen(text_buffers[i]);
+        memcpy(out, text_buffers[i] + start, end - start);
+        out += end - start;
+        if (i < sel_end.line) *out++ = '\n';
+    }
+    *out = '\0';
+    clip->len = out - clip->text;
+    // On success SDL owns clip and calls clipboard_cleanup when the data is replaced
+    if (!SDL_SetClipboardData(clipboard_data, clipboard_cleanup, clip,
+                              clipboard_mime_types, SDL_arraysize(clipboard_mime_types))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Clipboard copy failed: %s", SDL_GetError());
+    }
+}
+
+// Highlight the selected part of a visible line
+static void render_selection(int line, float y) {
+    const char *text = text_buffers[line];
+    int start = line == sel_start.line ? sel_start.col : 0;
+    int end = line == sel_end.line ? sel_end.col : (int)strlen(text);
+    int start_x = 0, end_x = 0;
+    if (start > 0) TTF_GetStringSize(font, text, start, &start_x, NULL);
+    if (end > 0) TTF_GetStringSize(font, text, end, &end_x, NULL);
+    if (line != sel_end.line) end_x += 4; // Show the line break as selected
+    if (end_x <= start_x) return;
+    SDL_FRect rect = {TEXT_MARGIN + start_x, y, end_x - start_x, LINE_HEIGHT};
+    SDL_SetRenderDrawColor(renderer, selection_color.r, selection_color.g, selection_color.b, selection_color.a);
+    SDL_RenderFillRect(renderer, &rect);
+}
+
+// Command registry: entries are kept in registration order in command_list,
+// command_buckets is an open-addressed hash table of indices into it
+static Command *command_list = NULL;
+static int command_count = 0;
+static int command_capacity = 0;
+static int *command_buckets = NULL; // -1 marks an empty bucket
+static int bucket_count = 0; // Power of two
+static char *help_text_cache = NULL; // Rebuilt after registration, lines separated by '\n'
+static int help_text_width = 0; // max_text_width help_text_cache was wrapped to
+
+// Prefix trie shared by commands and history, used for Tab completion
+typedef struct TrieNode {
+    struct TrieNode *parent;
+    struct TrieNode *children; // Sorted by byte
+    struct TrieNode *next; // Next sibling
+    unsigned char byte;
+    bool is_command;
+    int history_refs; // History entries ending at this node
+    int terminal_count; // Completions in this subtree
+} TrieNode;
+
+static TrieNode completion_root = {0};
+
+static Uint32 hash_name(const char *name, size_t len) {
+    Uint32 hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Look up a command by the first len bytes of name
+static const Command *find_command(const char *name, size_t len) {
+    if (bucket_count == 0) return NULL;
+    Uint32 mask = bucket_count - 1;
+    for (Uint32 i = hash_name(name, len) & mask; command_buckets[i] != -1; i = (i + 1) & mask) {
+        const Command *command = &command_list[command_buckets[i]];
+        if (strncmp(command->name, name, len) == 0 && command->name[len] == '\0') {
+            return command;
+        }
+    }
+    return NULL;
+}
+
+static bool grow_command_buckets(void) {
+    int new_count = bucket_count ? bucket_count * 2 : 16;
+    int *buckets = malloc(new_count * sizeof(int));
+    if (!buckets) return false;
+    memset(buckets, -1, new_count * sizeof(int));
+    for (int i = 0; i < command_count; i++) {
+        Uint32 j = hash_name(command_list[i].name, strlen(command_list[i].name)) & (new_count - 1);
+        while (buckets[j] != -1) j = (j + 1) & (new_count - 1);
+        buckets[j] = i;
+    }
+    free(command_buckets);
+    command_buckets = buckets;
+    bucket_count = new_count;
+    return true;
+}
+
+static bool is_terminal(const TrieNode *node) {
+    return node->is_command || node->history_refs > 0;
+}
+
+static TrieNode *trie_find(const char *key, size_t len) {
+    TrieNode *node = &completion_root;
+    for (size_t i = 0; i < len && node; i++) {
+        TrieNode *child = node->children;
+        while (child && child->byte < (unsigned char)key[i]) child = child->next;
+        node = (child && child->byte == (unsigned char)key[i]) ? child : NULL;
+    }
+    return node;
+}
+
+// Add a command name or a history entry to the completion trie
+static bool trie_insert(const char *key, bool is_command) {
+    TrieNode *node = &completion_root;
+    for (const unsigned char *c = (const unsigned char *)key; *c; c++) {
+        TrieNode **link = &node->children;
+        while (*link && (*link)->byte < *c) link = &(*link)->next;
+        if (!*link || (*link)->byte != *c) {
+            TrieNode *child = calloc(1, sizeof(TrieNode));
+            if (!child) return false;
+            child->parent = node;
+            child->byte = *c;
+            child->next = *link;
+            *link = child;
+        }
+        node = *link;
+    }
+    bool was_terminal = is_terminal(node);
+    if (is_command) {
+        node->is_command = true;
+    } else {
+        node->history_refs++;
+    }
+    if (!was_terminal) {
+        for (TrieNode *n = node; n; n = n->parent) n->terminal_count++;
+    }
+    return true;
+}
+
+// Drop one history reference and prune branches that no longer complete to anything
+static void trie_remove_history(const char *key) {
+    TrieNode *node = trie_find(key, strlen(key));
+    if (!node || node->history_refs == 0) return;
+    node->history_refs--;
+    if (is_terminal(node)) return;
+    for (TrieNode *n = node; n; n = n->parent) n->terminal_count--;
+    while (node != &completion_root && !is_terminal(node) && !node->children) {
+        TrieNode *parent = node->parent;
+        TrieNode **link = &parent->children;
+        while (*link != node) link = &(*link)->next;
+        *link = node->next;
+        free(node);
+        node = parent;
+    }
+}
+
+static void trie_free(TrieNode *node) {
+    TrieNode *child = node->children;
+    while (child) {
+        TrieNode *next = child->next;
+        trie_free(child);
+        free(child);
+        child = next;
+    }
+    node->children = NULL;
+}
+
+// Depth-first walk collecting up to max completions below node; buf holds the path so far
+static int collect_completions(const TrieNode *node, char *buf, int len, char out[][MAX_TEXT_LENGTH], int found, int max) {
+    if (is_terminal(node) && found < max) {
+        buf[len] = '\0';
+        strcpy(out[found++], buf);
+    }
+    for (const TrieNode *child = node->children; child && found < max; child = child->next) {
+        if (len + 1 >= MAX_TEXT_LENGTH) break;
+        buf[len] = child->byte;
+        found = collect_completions(child, buf, len + 1, out, found, max);
+    }
+    return found;
+}
+
+// Register a command at runtime. Scripts and plugins call this to add commands or
+// aliases (description NULL keeps an alias out of help). Names must be unique and
+// contain no spaces.
+bool register_command(const char *name, void (*function)(const char *input), const char *description) {
+    if (!name || !*name || strchr(name, ' ') || strlen(name) >= MAX_TEXT_LENGTH || !function) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid command name: %s", name ? name : "(null)");
+        return false;
+    }
+    if (find_command(name, strlen(name))) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Command already registered: %s", name);
+        return false;
+    }
+    if (command_count == command_capacity) {
+        int new_capacity = command_capacity ? command_capacity * 2 : 16;
+        Command *list = realloc(command_list, new_capacity * sizeof(Command));
+        if (!list) return false;
+        command_list = list;
+        command_capacity = new_capacity;
+    }
+    if ((command_count + 1) * 2 > bucket_count && !grow_command_buckets()) return false;
+    char *name_copy = strdup(name);
+    char *description_copy = description ? strdup(description) : NULL;
+    if (!name_copy || (description && !description_copy) || !trie_insert(name, true)) {
+        free(name_copy);
+        free(description_copy);
+        return false;
+    }
+    Command *command = &command_list[command_count];
+    command->name = name_copy;
+    command->function = function;
+    command->description = description_copy;
+    Uint32 mask = bucket_count - 1;
+    Uint32 i = hash_name(name, strlen(name)) & mask;
+    while (command_buckets[i] != -1) i = (i + 1) & mask;
+    command_buckets[i] = command_count++;
+    // Help text is rebuilt on next use
+    free(help_text_cache);
+    help_text_cache = NULL;
+    return true;
+}
+
+void init_command_registry(void) {
+    for (int i = 0; i < num_builtin_commands; i++) {
+        if (!register_command(builtin_commands[i].name, builtin_commands[i].function, builtin_commands[i].description)) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Failed to register command: %s", builtin_commands[i].name);
+        }
+    }
+}
+
+void free_command_registry(void) {
+    for (int i = 0; i < command_count; i++) {
+        free((char *)command_list[i].name);
+        free((char *)command_list[i].description);
+    }
+    free(command_list);
+    free(command_buckets);
+    free(help_text_cache);
+    command_list = NULL;
+    command_buckets = NULL;
+    help_text_cache = NULL;
+    command_count = command_capacity = bucket_count = 0;
+    trie_free(&completion_root);
+}
+
+// Build "Commands: a, b, ..." once, wrapping lines to max_text_width
+static const char *get_help_text(void) {
+    if (help_text_cache && help_text_width == max_text_width) return help_text_cache;
+    free(help_text_cache);
+    help_text_width = max_text_width;
+    size_t size = sizeof("Commands: ");
+    for (int i = 0; i < command_count; i++) {
+        if (command_list[i].description) size += strlen(command_list[i].name) + 2;
+    }
+    help_text_cache = malloc(size);
+    if (!help_text_cache) return "Commands: (out of memory)";
+    char *out = help_text_cache;
+    char *line_start = out;
+    out += sprintf(out, "Commands: ");
+    bool first = true;
+    for (int i = 0; i < command_count; i++) {
+        if (!command_list[i].description) continue; // Only include commands with descriptions
+        size_t name_len = strlen(command_list[i].name);
+        if (!first) {
+            // Try ", name" on the current line; start a new line if it does not fit
+            out[0] = ',';
+            out[1] = ' ';
+            memcpy(out + 2, command_list[i].name, name_len);
+            size_t line_len = (size_t)(out - line_start) + 2 + name_len;
+            int width = 0;
+            TTF_GetStringSize(font, line_start, line_len, &width, NULL);
+            if (line_len < MAX_TEXT_LENGTH && width <= max_text_width) {
+                out += 2 + name_len;
+                first = false;
+                continue;
+            }
+            *out++ = '\n';
+            line_start = out;
+        }
+        memcpy(out, command_list[i].name, name_len);
+        out += name_len;
+        first = false;
+    }
+    *out = '\0';
+    return help_text_cache;
+}
+
 // Shift lines up to remove the oldest line
 void shift_lines_up(void) {
     // Free the oldest texture
@@ -81,6 +552,20 @@ void shift_lines_up(void) {
     if (scroll_offset > 0 && current_line < scroll_offset + LINES_PER_SCREEN) {
         scroll_offset--;
     }
+    // Keep the selection on the same text, dropping it once it scrolls out
+    if (has_selection || selecting) {
+        if (sel_end.line == 0) {
+            clear_selection();
+        } else {
+            TextPos *positions[] = {&sel_start, &sel_end, &anchor_start, &anchor_end};
+            for (int i = 0; i < 4; i++) {
+                if (--positions[i]->line < 0) {
+                    positions[i]->line = 0;
+                    positions[i]->col = 0;
+                }
+            }
+        }
+    }
 }
 
 // Re-wrap text based on current max_text_width
@@ -90,6 +575,8 @@ void rewrap_text(void) {
     SDL_Texture *temp_textures[MAX_LINES] = {NULL};
     int new_line_count = 0;
 
+    clear_selection(); // Line and column positions change when re-wrapping
+
     // Process each existing line
     for (int i = 0; i <= current_line && new_line_count < MAX_LINES; i++) {
         if (strlen(text_buffers[i]) == 0) {
@@ -194,6 +681,252 @@ void rewrap_text(void) {
     if (scroll_offset < 0) scroll_offset = 0;
 }
 
+// Re-create the texture for one line from text_buffers
+static bool update_line_texture(int line) {
+    if (textures[line]) SDL_DestroyTexture(textures[line]);
+    textures[line] = NULL;
+    if (text_buffers[line][0] == '\0') return true;
+    SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[line], strlen(text_buffers[line]), white);
+    if (!surface) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
+        return false;
+    }
+    textures[line] = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_DestroySurface(surface);
+    if (!textures[line]) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
+        return false;
+    }
+    return true;
+}
+
+// Advance to a new line, shifting out the oldest one if needed
+static void advance_line(void) {
+    if (current_line >= MAX_LINES - 1) {
+        shift_lines_up();
+    } else {
+        current_line++;
+    }
+}
+
+// Write a non-editable output line below the current line
+static void print_output_line(const char *text) {
+    advance_line();
+    strncpy(text_buffers[current_line], text, MAX_TEXT_LENGTH - 1);
+    text_buffers[current_line][MAX_TEXT_LENGTH - 1] = '\0';
+    is_line_editable[current_line] = false; // Output is not editable
+    update_line_texture(current_line);
+}
+
+// Start a new, empty input line and keep it visible
+static void new_input_line(void) {
+    advance_line();
+    text_buffers[current_line][0] = '\0';
+    if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
+    textures[current_line] = NULL;
+    is_line_editable[current_line] = true;
+    cursor_pos = 0;
+    history_pos = -1;
+    if (current_line >= scroll_offset + LINES_PER_SCREEN) {
+        scroll_offset++;
+    }
+}
+
+// Tab: extend the input to the longest unambiguous completion, or list candidates
+static void complete_input(void) {
+    char *text = text_buffers[current_line];
+    int len = strlen(text);
+    if (!is_line_editable[current_line] || cursor_pos != len) return;
+    TrieNode *node = trie_find(text, len);
+    if (!node || node->terminal_count == 0) return;
+    selection_line_edited(current_line);
+
+    int new_len = len;
+    while (!is_terminal(node) && node->children && !node->children->next && new_len < MAX_TEXT_LENGTH - 1) {
+        node = node->children;
+        text[new_len++] = node->byte;
+    }
+    // A unique command is ready for its arguments
+    if (node->terminal_count == 1 && node->is_command && new_len < MAX_TEXT_LENGTH - 1) {
+        text[new_len++] = ' ';
+    }
+    if (new_len > len) {
+        text[new_len] = '\0';
+        cursor_pos = new_len;
+        history_pos = -1;
+        update_line_texture(current_line);
+        return;
+    }
+    if (node->terminal_count < 2) return;
+
+    // Ambiguous: print the first candidates and repeat the input below them
+    char path[MAX_TEXT_LENGTH];
+    char suggestions[MAX_SUGGESTIONS][MAX_TEXT_LENGTH];
+    memcpy(path, text, len);
+    int found = collect_completions(node, path, len, suggestions, 0, MAX_SUGGESTIONS);
+    char list[MAX_TEXT_LENGTH] = {0};
+    size_t used = 0;
+    int printed = 0;
+    for (; printed < found; printed++) {
+        int written = snprintf(list + used, sizeof(list) - used, printed ? "  %s" : "%s", suggestions[printed]);
+        if (written < 0 || (size_t)written >= sizeof(list) - used) {
+            list[used] = '\0'; // Drop the truncated candidate
+            break;
+        }
+        used += written;
+    }
+    if (node->terminal_count > printed && used < sizeof(list)) {
+        snprintf(list + used, sizeof(list) - used, "  (+%d more)", node->terminal_count - printed);
+    }
+    char input[MAX_TEXT_LENGTH];
+    strcpy(input, text);
+    is_line_editable[current_line] = false;
+    print_output_line(list);
+    new_input_line();
+    strcpy(text_buffers[current_line], input);
+    cursor_pos = len;
+    update_line_texture(current_line);
+}
+
+// Remember when a key event arrived so its latency is recorded at the next present
+static void trace_key_event(Uint64 timestamp) {
+    if (latency_stats && pending_key_count < MAX_PENDING_KEYS) {
+        pending_keys[pending_key_count++] = timestamp;
+    }
+}
+
+static void present_frame(void) {
+    SDL_RenderPresent(renderer);
+    if (pending_key_count == 0) return;
+    Uint64 now = SDL_GetTicksNS();
+    for (int i = 0; i < pending_key_count; i++) {
+        Uint64 bucket = (now - pending_keys[i]) / (LATENCY_BUCKET_US * 1000);
+        latency_histogram[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS]++;
+        latency_samples++;
+    }
+    pending_key_count = 0;
+}
+
+// Format the upper bound of the histogram bucket holding the given fraction of samples
+static void format_latency_percentile(char *out, size_t size, double fraction) {
+    Uint64 target = (Uint64)(fraction * latency_samples);
+    if (target < fraction * latency_samples || target == 0) target++; // Round up
+    Uint64 seen = 0;
+    int bucket = 0;
+    for (; bucket < LATENCY_BUCKETS; bucket++) {
+        seen += latency_histogram[bucket];
+        if (seen >= target) break;
+    }
+    if (bucket == LATENCY_BUCKETS) {
+        // Overflow bucket: only the lower bound is known
+        snprintf(out, size, ">%.0fms", LATENCY_BUCKETS * LATENCY_BUCKET_US / 1000.0);
+    } else {
+        snprintf(out, size, "%.1fms", (bucket + 1) * LATENCY_BUCKET_US / 1000.0);
+    }
+}
+
+static void format_latency_report(char *out, size_t size) {
+    char p50[16], p99[16];
+    if (!latency_stats) {
+        snprintf(out, size, "Latency tracing is off (run with --latency-stats)");
+    } else if (latency_samples == 0) {
+        snprintf(out, size, "Latency: no key events yet");
+    } else {
+        format_latency_percentile(p50, sizeof(p50), 0.50);
+        format_latency_percentile(p99, sizeof(p99), 0.99);
+        snprintf(out, size, "Latency: %llu keys, p50 %s, p99 %s",
+                 (unsigned long long)latency_samples, p50, p99);
+    }
+}
+
+// Draw one text line (and its selection) at its row on screen
+static void render_line(int line) {
+    float y = TEXT_MARGIN + (line - scroll_offset) * LINE_HEIGHT;
+    if (has_selection && line >= sel_start.line && line <= sel_end.line) {
+        render_selection(line, y);
+    }
+    if (textures[line]) {
+        SDL_FRect dest = {TEXT_MARGIN, y, 0.0f, 0.0f};
+        SDL_GetTextureSize(textures[line], &dest.w, &dest.h);
+        SDL_RenderTexture(renderer, textures[line], NULL, &dest);
+    }
+}
+
+static void render_lines(void) {
+    SDL_SetRenderDrawColor(renderer, black.r, black.g, black.b, black.a);
+    SDL_RenderClear(renderer);
+    for (int i = scroll_offset; i <= current_line && i < scroll_offset + LINES_PER_SCREEN; i++) {
+        render_line(i);
+    }
+}
+
+static void render_cursor(void) {
+    int text_width = 0;
+    if (cursor_pos > 0) {
+        TTF_GetStringSize(font, text_buffers[current_line], cursor_pos, &text_width, NULL);
+    }
+    float cursor_x = TEXT_MARGIN + text_width;
+    float cursor_y = TEXT_MARGIN + (current_line - scroll_offset) * LINE_HEIGHT;
+    SDL_SetRenderDrawColor(renderer, white.r, white.g, white.b, white.a);
+    SDL_RenderLine(renderer, cursor_x, cursor_y, cursor_x, cursor_y + 16.0f); // 16px cursor height
+}
+
+// (Re)create frame_cache at the current output size
+static bool ensure_frame_cache(void) {
+    int w = 0, h = 0;
+    SDL_GetCurrentRenderOutputSize(renderer, &w, &h);
+    if (frame_cache && w == frame_cache_w && h == frame_cache_h) return true;
+    if (frame_cache) SDL_DestroyTexture(frame_cache);
+    frame_cache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, w, h);
+    if (!frame_cache) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Frame cache creation failed: %s", SDL_GetError());
+        return false;
+    }
+    SDL_SetTextureBlendMode(frame_cache, SDL_BLENDMODE_NONE);
+    frame_cache_w = w;
+    frame_cache_h = h;
+    return true;
+}
+
+static void render_frame(bool cursor_visible) {
+    if (input_priority && ensure_frame_cache()) {
+        // Keep the lines in frame_cache so a keystroke can redraw just its row
+        SDL_SetRenderTarget(renderer, frame_cache);
+        render_lines();
+        SDL_SetRenderTarget(renderer, NULL);
+        SDL_RenderTexture(renderer, frame_cache, NULL, NULL);
+    } else {
+        render_lines();
+    }
+    if (cursor_visible) {
+        render_cursor();
+    }
+    present_frame();
+}
+
+// Fast path: redraw only the given row into frame_cache, add the cursor and present
+static bool present_edited_row(int line) {
+    if (!frame_cache || line < scroll_offset || line >= scroll_offset + LINES_PER_SCREEN) return false;
+    SDL_FRect row = {0.0f, TEXT_MARGIN + (line - scroll_offset) * LINE_HEIGHT, frame_cache_w, LINE_HEIGHT};
+    SDL_SetRenderTarget(renderer, frame_cache);
+    SDL_SetRenderDrawColor(renderer, black.r, black.g, black.b, black.a);
+    SDL_RenderFillRect(renderer, &row);
+    render_line(line);
+    SDL_SetRenderTarget(renderer, NULL);
+    SDL_RenderTexture(renderer, frame_cache, NULL, NULL);
+    render_cursor();
+    present_frame();
+    return true;
+}
+
+// In input-priority mode keyboard events are taken ahead of the rest of the queue
+static bool next_event(SDL_Event *event) {
+    if (input_priority && SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_EVENT_KEY_DOWN, SDL_EVENT_TEXT_INPUT) == 1) {
+        return true;
+    }
+    return SDL_PollEvent(event);
+}
+
 // Command implementations
 void cmd_clear(const char *input) {
     for (int i = 0; i < MAX_LINES; i++) {
@@ -209,6 +942,7 @@ void cmd_clear(const char *input) {
     cursor_pos = 0;
     history_pos = -1;
     is_line_editable[0] = true; // New input line is editable
+    clear_selection();
 }
 
 void cmd_exit(const char *input) {
@@ -216,73 +950,65 @@ void cmd_exit(const char *input) {
 }
 
 void cmd_help(const char *input) {
-    // Check if we need to shift lines
-    if (current_line >= MAX_LINES - 1) {
-        shift_lines_up();
-    } else {
-        current_line++;
-    }
-    // Build help text
-    char help_text[MAX_TEXT_LENGTH] = "Commands: ";
-    int first = 1;
-    for (int i = 0; i < num_commands; i++) {
-        if (commands[i].description) { // Only include commands with descriptions
-            if (!first) {
-                strcat(help_text, ", ");
-            }
-            strcat(help_text, commands[i].name);
-            first = 0;
-        }
-    }
-    // Copy to buffer
-    strcpy(text_buffers[current_line], help_text);
-    is_line_editable[current_line] = false; // Help output is not editable
-    // Update texture
-    if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-    SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-    if (!surface) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Help text rendering failed: %s", SDL_GetError());
-        return;
-    }
-    textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_DestroySurface(surface);
-    if (!textures[current_line]) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Help texture creation failed: %s", SDL_GetError());
-        return;
+    // Help text is cached; print one output line per '\n'-separated chunk
+    const char *text = get_help_text();
+    while (true) {
+        char line[MAX_TEXT_LENGTH];
+        size_t len = strcspn(text, "\n");
+        memcpy(line, text, len);
+        line[len] = '\0';
+        print_output_line(line);
+        if (text[len] == '\0') break;
+        text += len + 1;
     }
 }
 
 void cmd_echo(const char *input) {
-    // Check if we need to shift lines
-    if (current_line >= MAX_LINES - 1) {
-        shift_lines_up();
-    } else {
-        current_line++;
-    }
-    // Extract text after "echo"
-    const char *text = input + 4; // Skip "echo"
+    // Extract text after the command name (also works for aliases)
+    const char *text = input + strcspn(input, " ");
     while (*text == ' ') text++; // Skip leading spaces
-    // Copy to buffer (empty if no text)
-    strcpy(text_buffers[current_line], text);
-    is_line_editable[current_line] = false; // Echo output is not editable
-    // Update texture
-    if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-    SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-    if (!surface) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Echo text rendering failed: %s", SDL_GetError());
+    print_output_line(text); // Empty if no text
+}
+
+void cmd_latency(const char *input) {
+    char report[MAX_TEXT_LENGTH];
+    format_latency_report(report, sizeof(report));
+    print_output_line(report);
+}
+
+void cmd_alias(const char *input) {
+    // Parse "alias <name> <command>"
+    char name[MAX_TEXT_LENGTH] = {0};
+    char target[MAX_TEXT_LENGTH] = {0};
+    const char *args = input + strcspn(input, " ");
+    if (sscanf(args, "%255s %255s", name, target) != 2) {
+        print_output_line("Usage: alias <name> <command>");
         return;
     }
-    textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_DestroySurface(surface);
-    if (!textures[current_line]) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Echo texture creation failed: %s", SDL_GetError());
+    const Command *command = find_command(target, strlen(target));
+    if (!command) {
+        print_output_line("alias: unknown command");
         return;
     }
+    if (!register_command(name, command->function, NULL)) {
+        print_output_line("alias: name already in use");
+    }
 }
 
 int main(int argc, char *argv[]) {
     printf("SDL3 freetype\n");
 
+    // Parse flags
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--input-priority") == 0) {
+            input_priority = true;
+        } else if (strcmp(argv[i], "--latency-stats") == 0) {
+            latency_stats = true;
+        } else {
+            printf("Unknown option: %s (options: --input-priority, --latency-stats)\n", argv[i]);
+        }
+    }
+
     // Initialize SDL
     if (!SDL_Init(SDL_INIT_VIDEO)) { // SDL 3.x api return bool
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't initialize SDL: %s", SDL_GetError());
@@ -322,6 +1048,8 @@ int main(int argc, char *argv[]) {
     // Enable text input
     SDL_StartTextInput(window);
 
+    init_command_registry();
+
     // Initialize text buffer with welcome message
     strcpy(text_buffers[0], "SDL3 terminal. License: MIT");
     strcpy(text_buffers[1], "Simple test terminal emulator.");
@@ -331,7 +1059,6 @@ int main(int argc, char *argv[]) {
     scroll_offset = 0;
     cursor_pos = 0;
     is_line_editable[2] = true; // Input line is editable
-    SDL_Color black = {0, 0, 0, 255};
     bool cursor_visible = true;
     Uint32 last_cursor_toggle = 0;
 
@@ -370,7 +1097,13 @@ int main(int argc, char *argv[]) {
     // Main loop
     while (is_running) {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        bool frame_dirty = false; // Something besides the current line changed
+        bool presented_early = false; // Input-priority fast path already presented
+        if (input_priority) SDL_PumpEvents();
+        while (!presented_early && next_event(&event)) {
+            bool row_edit = false; // Only the current line's text or cursor changed
+            bool no_change = false;
+            bool had_selection = has_selection;
             switch (event.type) {
                 case SDL_EVENT_QUIT:
                     is_running = false;
@@ -400,44 +1133,79 @@ int main(int argc, char *argv[]) {
                     }
                     break;
                 }
+                case SDL_EVENT_MOUSE_BUTTON_DOWN: {
+                    // Start a selection: 1 click = character, 2 = word, 3 = line
+                    if (event.button.button != SDL_BUTTON_LEFT) break;
+                    SDL_ConvertEventToRenderCoordinates(renderer, &event);
+                    if (event.button.clicks >= 3) {
+                        select_mode = SELECT_LINE;
+                    } else if (event.button.clicks == 2) {
+                        select_mode = SELECT_WORD;
+                    } else {
+                        select_mode = SELECT_CHAR;
+                    }
+                    drag_x = event.button.x;
+                    drag_y = event.button.y;
+                    expand_unit(hit_test(drag_x, drag_y), &anchor_start, &anchor_end);
+                    sel_start = anchor_start;
+                    sel_end = anchor_end;
+                    has_selection = compare_pos(sel_start, sel_end) != 0;
+                    // SDL auto-captures the mouse while the button is held, so motion
+                    // outside the window still arrives for auto-scroll
+                    selecting = true;
+                    break;
+                }
+                case SDL_EVENT_MOUSE_MOTION: {
+                    if (!selecting) {
+                        no_change = true;
+                        break;
+                    }
+                    SDL_ConvertEventToRenderCoordinates(renderer, &event);
+                    drag_x = event.motion.x;
+                    drag_y = event.motion.y;
+                    update_selection(hit_test(drag_x, drag_y));
+                    break;
+                }
+                case SDL_EVENT_MOUSE_BUTTON_UP: {
+                    if (event.button.button == SDL_BUTTON_LEFT) {
+                        selecting = false;
+                    }
+                    no_change = true;
+                    break;
+                }
+                case SDL_EVENT_KEY_UP:
+                    no_change = true;
+                    break;
                 case SDL_EVENT_TEXT_INPUT: {
                     // Check if adding text exceeds screen width
                     size_t current_len = strlen(text_buffers[current_line]);
                     size_t input_len = strlen(event.text.text);
                     if (current_len + input_len < MAX_TEXT_LENGTH - 1 && is_line_editable[current_line]) {
+                        selection_line_edited(current_line);
                         // Create temporary buffer with new text inserted
                         char temp[MAX_TEXT_LENGTH] = {0};
                         strncpy(temp, text_buffers[current_line], cursor_pos);
                         strcat(temp, event.text.text);
                         strcat(temp, &text_buffers[current_line][cursor_pos]);
-                        // Measure width
-                        SDL_Surface *surface = TTF_RenderText_Solid(font, temp, strlen(temp), white);
+                        // Measure width without rendering a throwaway texture
+                        int text_width = 0;
                         bool wrap = false;
-                        if (surface) {
-                            SDL_Texture *temp_texture = SDL_CreateTextureFromSurface(renderer, surface);
-                            SDL_DestroySurface(surface);
-                            if (temp_texture) {
-                                float text_width;
-                                SDL_GetTextureSize(temp_texture, &text_width, NULL);
-                                SDL_DestroyTexture(temp_texture);
-                                if (text_width > max_text_width) {
-                                    // Check if we need to shift lines
-                                    if (current_line >= MAX_LINES - 1) {
-                                        shift_lines_up();
-                                    } else {
-                                        current_line++;
-                                    }
-                                    text_buffers[current_line][0] = '\0';
-                                    cursor_pos = 0;
-                                    if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                                    textures[current_line] = NULL;
-                                    is_line_editable[current_line] = true;
-                                    if (current_line >= scroll_offset + LINES_PER_SCREEN) {
-                                        scroll_offset++;
-                                    }
-                                    wrap = true;
-                                }
+                        if (TTF_GetStringSize(font, temp, strlen(temp), &text_width, NULL) && text_width > max_text_width) {
+                            // Check if we need to shift lines
+                            if (current_line >= MAX_LINES - 1) {
+                                shift_lines_up();
+                            } else {
+                                current_line++;
+                            }
+                            text_buffers[current_line][0] = '\0';
+                            cursor_pos = 0;
+                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
+                            textures[current_line] = NULL;
+                            is_line_editable[current_line] = true;
+                            if (current_line >= scroll_offset + LINES_PER_SCREEN) {
+                                scroll_offset++;
                             }
+                            wrap = true;
                         }
                         // Insert text at cursor position
                         if (!wrap) {
@@ -451,29 +1219,28 @@ int main(int argc, char *argv[]) {
                             cursor_pos = input_len;
                         }
                         history_pos = -1; // Reset history position
+                        row_edit = !wrap;
                         // Update texture for current line
-                        if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                        if (strlen(text_buffers[current_line]) > 0) {
-                            SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-                            if (!surface) {
-                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
-                                is_running = false;
-                                break;
-                            }
-                            textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-                            SDL_DestroySurface(surface);
-                            if (!textures[current_line]) {
-                                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
-                                is_running = false;
-                            }
-                        } else {
-                            textures[current_line] = NULL;
+                        if (!update_line_texture(current_line)) {
+                            is_running = false;
+                            break;
                         }
                     }
                     break;
                 }
                 case SDL_EVENT_KEY_DOWN:
-                    if (event.key.key == SDLK_BACKSPACE) {
+                    trace_key_event(event.key.timestamp);
+                    // Line-editing keys only touch the current line
+                    row_edit = event.key.key == SDLK_BACKSPACE || event.key.key == SDLK_DELETE ||
+                               event.key.key == SDLK_LEFT || event.key.key == SDLK_UP || event.key.key == SDLK_DOWN;
+                    if (row_edit && event.key.key != SDLK_LEFT && is_line_editable[current_line]) {
+                        selection_line_edited(current_line);
+                    }
+                    if (event.key.key == SDLK_C && (event.key.mod & SDL_KMOD_CTRL)) {
+                        // Copy the selection
+                        copy_selection();
+                        no_change = true;
+                    } else if (event.key.key == SDLK_BACKSPACE) {
                         if (cursor_pos > 0 && is_line_editable[current_line]) {
                             // Remove character before cursor
                             memmove(&text_buffers[current_line][cursor_pos - 1],
@@ -482,23 +1249,9 @@ int main(int argc, char *argv[]) {
                             cursor_pos--;
                             history_pos = -1;
                             // Update texture
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            if (strlen(text_buffers[current_line]) > 0) {
-                                SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-                                if (!surface) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                                textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-                                SDL_DestroySurface(surface);
-                                if (!textures[current_line]) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                            } else {
-                                textures[current_line] = NULL;
+                            if (!update_line_texture(current_line)) {
+                                is_running = false;
+                                break;
                             }
                         }
                         // Prevent moving to previous line if it's not editable
@@ -510,23 +1263,9 @@ int main(int argc, char *argv[]) {
                                     strlen(text_buffers[current_line]) - cursor_pos);
                             history_pos = -1;
                             // Update texture
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            if (strlen(text_buffers[current_line]) > 0) {
-                                SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-                                if (!surface) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                                textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-                                SDL_DestroySurface(surface);
-                                if (!textures[current_line]) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                            } else {
-                                textures[current_line] = NULL;
+                            if (!update_line_texture(current_line)) {
+                                is_running = false;
+                                break;
                             }
                         }
                     } else if (event.key.key == SDLK_LEFT) {
@@ -542,23 +1281,9 @@ int main(int argc, char *argv[]) {
                             strcpy(text_buffers[current_line], command_history[history_count - 1 - history_pos]);
                             cursor_pos = strlen(text_buffers[current_line]);
                             // Update texture
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            if (strlen(text_buffers[current_line]) > 0) {
-                                SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-                                if (!surface) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                                textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-                                SDL_DestroySurface(surface);
-                                if (!textures[current_line]) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                            } else {
-                                textures[current_line] = NULL;
+                            if (!update_line_texture(current_line)) {
+                                is_running = false;
+                                break;
                             }
                         }
                     } else if (event.key.key == SDLK_DOWN) {
@@ -572,43 +1297,22 @@ int main(int argc, char *argv[]) {
                             }
                             cursor_pos = strlen(text_buffers[current_line]);
                             // Update texture
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            if (strlen(text_buffers[current_line]) > 0) {
-                                SDL_Surface *surface = TTF_RenderText_Solid(font, text_buffers[current_line], strlen(text_buffers[current_line]), white);
-                                if (!surface) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Text rendering failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                                textures[current_line] = SDL_CreateTextureFromSurface(renderer, surface);
-                                SDL_DestroySurface(surface);
-                                if (!textures[current_line]) {
-                                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Texture creation failed: %s", SDL_GetError());
-                                    is_running = false;
-                                    break;
-                                }
-                            } else {
-                                textures[current_line] = NULL;
+                            if (!update_line_texture(current_line)) {
+                                is_running = false;
+                                break;
                             }
                         }
+                    } else if (event.key.key == SDLK_TAB) {
+                        complete_input();
                     } else if (event.key.key == SDLK_RETURN) {
-                        // Check for commands
-                        bool is_command = false;
-                        bool is_clear = false;
-                        int command_index = -1;
-                        for (int i = 0; i < num_commands; i++) {
-                            // Check if input starts with command name
-                            int cmd_len = strlen(commands[i].name);
-                            if (strncmp(text_buffers[current_line], commands[i].name, cmd_len) == 0 &&
-                                (text_buffers[current_line][cmd_len] == '\0' || text_buffers[current_line][cmd_len] == ' ')) {
-                                if (strcmp(commands[i].name, "clear") == 0) {
-                                    is_clear = true;
-                                }
-                                commands[i].function(text_buffers[current_line]);
-                                is_command = true;
-                                command_index = i;
-                                break;
-                            }
+                        // Look up the first word in the command registry
+                        const char *input = text_buffers[current_line];
+                        const Command *command = find_command(input, strcspn(input, " "));
+                        // Copy the handler first: a command may register others and move command_list
+                        void (*function)(const char *input) = command ? command->function : NULL;
+                        bool is_command = function != NULL;
+                        if (is_command) {
+                            function(input);
                         }
                         if (!is_command && strlen(text_buffers[current_line]) > 0) {
                             // Store in history if not empty
@@ -616,92 +1320,63 @@ int main(int argc, char *argv[]) {
                             if (history_count < MAX_HISTORY) {
                                 command_history[history_count] = strdup(text_buffers[current_line]);
                                 if (command_history[history_count]) {
+                                    trie_insert(command_history[history_count], false);
                                     history_count++;
                                 }
                             } else {
                                 // Free oldest command and shift
+                                trie_remove_history(command_history[0]);
                                 free(command_history[0]);
                                 memmove(&command_history[0], &command_history[1], (MAX_HISTORY - 1) * sizeof(char *));
                                 command_history[MAX_HISTORY - 1] = strdup(text_buffers[current_line]);
+                                if (command_history[MAX_HISTORY - 1]) {
+                                    trie_insert(command_history[MAX_HISTORY - 1], false);
+                                }
                             }
-                            // Move to next line
-                            if (current_line >= MAX_LINES - 1) {
-                                shift_lines_up();
-                            } else {
-                                current_line++;
-                            }
-                            text_buffers[current_line][0] = '\0';
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            textures[current_line] = NULL;
-                            is_line_editable[current_line] = true;
-                            cursor_pos = 0;
-                            history_pos = -1;
-                            if (current_line >= scroll_offset + LINES_PER_SCREEN) {
-                                scroll_offset++;
-                            }
-                        } else if (is_command && !is_clear && command_index >= 0 && strcmp(commands[command_index].name, "exit") != 0) {
+                            new_input_line();
+                        } else if (is_command && function != cmd_clear && function != cmd_exit) {
                             // Move to next line for help and echo
-                            if (current_line >= MAX_LINES - 1) {
-                                shift_lines_up();
-                            } else {
-                                current_line++;
-                            }
-                            text_buffers[current_line][0] = '\0';
-                            if (textures[current_line]) SDL_DestroyTexture(textures[current_line]);
-                            textures[current_line] = NULL;
-                            is_line_editable[current_line] = true;
-                            cursor_pos = 0;
-                            history_pos = -1;
-                            if (current_line >= scroll_offset + LINES_PER_SCREEN) {
-                                scroll_offset++;
-                            }
+                            new_input_line();
                         }
                         break;
+                    } else if (event.key.key != SDLK_TAB) {
+                        // Keys that only produce text are handled by SDL_EVENT_TEXT_INPUT
+                        no_change = true;
                     }
             }
+            if (had_selection && !has_selection) {
+                row_edit = false; // The highlight may span other rows; redraw them all
+            }
+            if (row_edit && input_priority && !frame_dirty && is_running) {
+                presented_early = present_edited_row(current_line);
+                if (presented_early) {
+                    // Show the cursor solid while typing
+                    cursor_visible = true;
+                    last_cursor_toggle = SDL_GetTicks();
+                }
+            }
+            if (!row_edit && !no_change) {
+                frame_dirty = true;
+            }
         }
 
         // Update cursor blink
         Uint32 current_time = SDL_GetTicks();
+        bool cursor_toggled = false;
         if (current_time - last_cursor_toggle >= CURSOR_BLINK_MS) {
             cursor_visible = !cursor_visible;
             last_cursor_toggle = current_time;
+            cursor_toggled = true;
         }
-
-        // Render
-        SDL_SetRenderDrawColor(renderer, black.r, black.g, black.b, black.a);
-        SDL_RenderClear(renderer);
-        // Render visible lines
-        for (int i = scroll_offset; i <= current_line && i < scroll_offset + LINES_PER_SCREEN; i++) {
-            if (textures[i]) {
-                SDL_FRect dest = {10.0f, 10.0f + (i - scroll_offset) * 20.0f, 0.0f, 0.0f}; // 20px vertical spacing
-                SDL_GetTextureSize(textures[i], &dest.w, &dest.h);
-                SDL_RenderTexture(renderer, textures[i], NULL, &dest);
-            }
+        // Auto-scroll while dragging a selection past the top or bottom edge
+        if (selecting) {
+            autoscroll_selection(current_time);
         }
-        // Render blinking cursor on current line
-        if (cursor_visible) {
-            float text_width = 0.0f;
-            if (textures[current_line] && cursor_pos > 0) {
-                // Create temporary string up to cursor_pos
-                char temp[MAX_TEXT_LENGTH] = {0};
-                strncpy(temp, text_buffers[current_line], cursor_pos);
-                SDL_Surface *surface = TTF_RenderText_Solid(font, temp, strlen(temp), white);
-                if (surface) {
-                    SDL_Texture *temp_texture = SDL_CreateTextureFromSurface(renderer, surface);
-                    SDL_DestroySurface(surface);
-                    if (temp_texture) {
-                        SDL_GetTextureSize(temp_texture, &text_width, NULL);
-                        SDL_DestroyTexture(temp_texture);
-                    }
-                }
-            }
-            float cursor_x = 10.0f + text_width;
-            float cursor_y = 10.0f + (current_line - scroll_offset) * 20.0f;
-            SDL_SetRenderDrawColor(renderer, white.r, white.g, white.b, white.a);
-            SDL_RenderLine(renderer, cursor_x, cursor_y, cursor_x, cursor_y + 16.0f); // 16px cursor height
+
+        // Render, unless the fast path already presented everything that changed
+        if (!presented_early || cursor_toggled || selecting) {
+            render_frame(cursor_visible);
         }
-        SDL_RenderPresent(renderer);
     }
 
     // Cleanup
@@ -711,6 +1386,13 @@ int main(int argc, char *argv[]) {
     for (int i = 0; i < history_count; i++) {
         free(command_history[i]);
     }
+    free_command_registry();
+    if (frame_cache) SDL_DestroyTexture(frame_cache);
+    if (latency_stats) {
+        char report[MAX_TEXT_LENGTH];
+        format_latency_report(report, sizeof(report));
+        printf("%s\n", report);
+    }
     TTF_CloseFont(font);
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);